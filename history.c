@@ -0,0 +1,219 @@
+/*
+    Playback Status Widget plugin for the DeaDBeeF audio player
+
+    Copyright (C) 2015 Christian Boxdörfer <christian.boxdoerfer@posteo.de>
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <glib.h>
+
+#include "history.h"
+
+// records are written at the latest this long after the first one was queued
+#define HISTORY_FLUSH_DELAY (60 * G_USEC_PER_SEC)
+// ... or as soon as this many are queued
+#define HISTORY_BATCH_SIZE 64
+// the file is synced at most this often (and when the writer stops)
+#define HISTORY_SYNC_INTERVAL (15 * 60 * G_USEC_PER_SEC)
+
+G_LOCK_DEFINE_STATIC (history);
+static GThread *writer = NULL;
+static GAsyncQueue *queue = NULL;
+static char *history_path = NULL;
+// pushed to the queue to stop the writer
+static history_record_t stop_marker;
+
+static int
+write_all (int fd, const void *buf, size_t size)
+{
+    const char *p = buf;
+    while (size > 0) {
+        ssize_t res = write (fd, p, size);
+        if (res < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        p += res;
+        size -= res;
+    }
+    return 0;
+}
+
+static int
+history_header_valid (int fd)
+{
+    history_header_t header;
+    if (pread (fd, &header, sizeof (header), 0) != sizeof (header)) {
+        return 0;
+    }
+    return !memcmp (header.magic, HISTORY_MAGIC, sizeof (header.magic))
+        && header.version == HISTORY_VERSION
+        && header.record_size == sizeof (history_record_t);
+}
+
+static int
+history_open (const char *path)
+{
+    int fd = open (path, O_RDWR | O_APPEND | O_CREAT, 0644);
+    if (fd < 0) {
+        fprintf (stderr, "playback_status: failed to open history %s: %s\n", path, strerror (errno));
+        return -1;
+    }
+    struct stat st;
+    if (fstat (fd, &st) < 0) {
+        close (fd);
+        return -1;
+    }
+    if (st.st_size > 0 && st.st_size < (off_t)sizeof (history_header_t)) {
+        // the header was only partially written, there is nothing to keep
+        if (ftruncate (fd, 0) < 0) {
+            close (fd);
+            return -1;
+        }
+        st.st_size = 0;
+    }
+    else if (st.st_size > 0 && !history_header_valid (fd)) {
+        // not a history of this version, keep it aside and start a new one
+        char *old_path = g_strdup_printf ("%s.%" G_GINT64_FORMAT ".bad", path, g_get_real_time () / G_USEC_PER_SEC);
+        fprintf (stderr, "playback_status: invalid history header, moving %s to %s\n", path, old_path);
+        int res = rename (path, old_path);
+        g_free (old_path);
+        close (fd);
+        if (res < 0) {
+            return -1;
+        }
+        return history_open (path);
+    }
+
+    if (st.st_size == 0) {
+        history_header_t header = {
+            .magic = HISTORY_MAGIC,
+            .version = HISTORY_VERSION,
+            .record_size = sizeof (history_record_t),
+        };
+        if (write_all (fd, &header, sizeof (header)) < 0) {
+            close (fd);
+            return -1;
+        }
+    }
+    else if (st.st_size > (off_t)sizeof (history_header_t)) {
+        // drop a record that was only partially written
+        off_t tail = (st.st_size - sizeof (history_header_t)) % sizeof (history_record_t);
+        if (tail && ftruncate (fd, st.st_size - tail) < 0) {
+            close (fd);
+            return -1;
+        }
+    }
+    return fd;
+}
+
+static gpointer
+history_writer_thread (gpointer data)
+{
+    int fd = history_open (history_path);
+    history_record_t batch[HISTORY_BATCH_SIZE];
+    int num_batched = 0;
+    int unsynced = 0;
+    gint64 batch_start = 0;
+    gint64 last_sync = g_get_monotonic_time ();
+
+    for (;;) {
+        history_record_t *rec;
+        if (num_batched == 0) {
+            rec = g_async_queue_pop (queue);
+            batch_start = g_get_monotonic_time ();
+        }
+        else {
+            gint64 timeout = batch_start + HISTORY_FLUSH_DELAY - g_get_monotonic_time ();
+            rec = timeout > 0 ? g_async_queue_timeout_pop (queue, timeout) : NULL;
+        }
+
+        int stop = rec == &stop_marker;
+        if (rec && !stop) {
+            memcpy (&batch[num_batched++], rec, sizeof (history_record_t));
+            g_free (rec);
+        }
+        if (num_batched > 0 && (!rec || stop || num_batched == HISTORY_BATCH_SIZE)) {
+            if (fd >= 0 && write_all (fd, batch, num_batched * sizeof (history_record_t)) < 0) {
+                fprintf (stderr, "playback_status: failed to write history: %s\n", strerror (errno));
+            }
+            num_batched = 0;
+            unsynced = 1;
+        }
+        if (fd >= 0 && unsynced && (stop || g_get_monotonic_time () - last_sync >= HISTORY_SYNC_INTERVAL)) {
+            fsync (fd);
+            last_sync = g_get_monotonic_time ();
+            unsynced = 0;
+        }
+        if (stop) {
+            break;
+        }
+    }
+    if (fd >= 0) {
+        close (fd);
+    }
+    return NULL;
+}
+
+int
+history_start (const char *path)
+{
+    G_LOCK (history);
+    if (!writer) {
+        history_path = g_strdup (path);
+        queue = g_async_queue_new ();
+        writer = g_thread_new ("playback_status_history", history_writer_thread, NULL);
+    }
+    G_UNLOCK (history);
+    return 0;
+}
+
+void
+history_stop (void)
+{
+    G_LOCK (history);
+    if (writer) {
+        g_async_queue_push (queue, &stop_marker);
+        g_thread_join (writer);
+        writer = NULL;
+        g_async_queue_unref (queue);
+        queue = NULL;
+        g_free (history_path);
+        history_path = NULL;
+    }
+    G_UNLOCK (history);
+}
+
+void
+history_append (const history_record_t *rec)
+{
+    G_LOCK (history);
+    if (queue) {
+        history_record_t *copy = g_new (history_record_t, 1);
+        memcpy (copy, rec, sizeof (history_record_t));
+        g_async_queue_push (queue, copy);
+    }
+    G_UNLOCK (history);
+}
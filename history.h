@@ -0,0 +1,60 @@
+/*
+    Playback Status Widget plugin for the DeaDBeeF audio player
+
+    Copyright (C) 2015 Christian Boxdörfer <christian.boxdoerfer@posteo.de>
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stdint.h>
+
+// The playback history is an append-only file: one history_header_t
+// followed by fixed size history_record_t's, all in host byte order.
+
+#define HISTORY_MAGIC "DDBPSHST"
+#define HISTORY_VERSION 1
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+} history_header_t;
+
+typedef struct {
+    int64_t started;        // unix time the track started playing
+    float playtime;         // seconds the track was played
+    uint16_t num_lines;
+    uint16_t reserved;
+    char text[240];         // status lines separated by '\n', zero padded
+} history_record_t;
+
+typedef char history_record_size_check[sizeof (history_record_t) == 256 ? 1 : -1];
+
+// opens path for appending and starts the writer thread
+int
+history_start (const char *path);
+
+// writes all queued records, syncs the file and stops the writer thread
+void
+history_stop (void);
+
+// queues a copy of rec for writing, never blocks on file I/O
+void
+history_append (const history_record_t *rec);
+
+#endif
@@ -25,80 +25,188 @@
 #include <assert.h>
 #include <math.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <time.h>
 #include <gtk/gtk.h>
 
 #include <deadbeef/deadbeef.h>
 #include <deadbeef/gtkui_api.h>
 
 #include "fastftoi.h"
+#include "history.h"
 #include "support.h"
 
 #define MAX_LINES 10
+#define MAX_TOOLTIP_LINES 10
+#define MAX_HISTORY_LINES 3
+#define MIN_REFRESH_INTERVAL 10
+#define MAX_REFRESH_INTERVAL 10000
 
 #define     CONFSTR_VM_REFRESH_INTERVAL       "playback_status.refresh_interval"
 #define     CONFSTR_VM_NUM_LINES              "playback_status.num_lines"
 #define     CONFSTR_VM_FORMAT                 "playback_status.format."
+#define     CONFSTR_VM_FIXED_LAYOUT           "playback_status.fixed_layout"
+#define     CONFSTR_VM_MARQUEE                "playback_status.marquee"
+#define     CONFSTR_VM_HISTORY                "playback_status.history"
+#define     CONFSTR_VM_HISTORY_FORMAT         "playback_status.history_format."
+#define     CONFSTR_VM_TOOLTIP_NUM_LINES      "playback_status.tooltip_num_lines"
+#define     CONFSTR_VM_TOOLTIP_FORMAT         "playback_status.tooltip_format."
+#define     CONFSTR_VM_INSTANCE               "playback_status.instance."
+
+// scroll speed in pixels per second
+#define MARQUEE_SPEED 40
+// pause at the start of each cycle in microseconds
+#define MARQUEE_PAUSE (2 * G_USEC_PER_SEC)
+// space between the end of the text and its next repetition
+#define MARQUEE_GAP 40
+// redraw interval in ms where no frame clock is available
+#define MARQUEE_INTERVAL 33
+
+#define HISTORY_FORMAT_00 "%tracknumber%. %title%"
+#define HISTORY_FORMAT_01 "%album% - %album artist%"
+#define HISTORY_FORMAT_02 ""
+
+#if PANGO_VERSION_CHECK(1,38,0)
+#define TABULAR_DIGITS_OPEN "<span font_features='tnum'>"
+#define TABULAR_DIGITS_CLOSE "</span>"
+#else
+#define TABULAR_DIGITS_OPEN ""
+#define TABULAR_DIGITS_CLOSE ""
+#endif
 
 /* Global variables */
 static DB_misc_t            plugin;
 static DB_functions_t *     deadbeef = NULL;
 static ddb_gtkui_t *        gtkui_plugin = NULL;
 
+// markup is parsed only when its tag structure changes, text changes within
+// the same structure are applied directly to text and attrs
+typedef struct {
+    GString *markup;        // markup the label currently displays
+    GString *text;          // markup without tags and with entities resolved
+    PangoAttrList *attrs;   // attributes of text
+    int shown;              // label displays markup
+    int parsed;             // text and attrs belong to markup
+    // text and attrs are drawn by the widget into the reserved height of the
+    // label, so that updates only cause redraws (fixed layout mode)
+    int drawn;
+    // width of the widest value of the time fields, drawn lines are
+    // positioned as if they were that wide so that they don't move on updates
+    int reserved_width;
+    // text rendered once for scrolling, NULL if it fits into the label
+    cairo_surface_t *marquee;
+    int marquee_width;
+    int marquee_height;
+    gint64 marquee_start;
+    int marquee_offset;     // offset last drawn, -1 after rendering
+} playback_status_line_t;
+
+// settings of a single widget instance, saved with the gtkui layout
+typedef struct {
+    int refresh_interval;
+    int num_lines;
+    int fixed_layout;
+    int marquee;
+    gchar *format[MAX_LINES];
+    int tooltip_num_lines;
+    gchar *tooltip_format[MAX_TOOLTIP_LINES];
+} playback_status_config_t;
+
 typedef struct {
     ddb_gtkui_widget_t base;
+    playback_status_config_t conf;
+    // identifies the settings of this instance in the deadbeef config
+    guint32 id;
+    GtkWidget *vbox;
     GtkWidget *label[MAX_LINES];
     GtkWidget *popup;
     GtkWidget *popup_item;
     cairo_surface_t *surf;
     char *bytecode[MAX_LINES];
+    // same as bytecode, but with the time fields replaced by their maximum
+    // (NULL if the line has no time fields)
+    char *measure_bytecode[MAX_LINES];
+    // same for streams, which have no length to derive the maximum from
+    char *stream_measure_bytecode[MAX_LINES];
+    playback_status_line_t line[MAX_LINES];
+    char *tooltip_bytecode[MAX_TOOLTIP_LINES];
+    // evaluated tooltip, NULL until requested after a track or info change
+    char *tooltip;
+    // frame clock tick callback or timeout driving the marquee
+    guint marquee_timer;
+    gint64 marquee_time;
     guint drawtimer;
+    guint reserve_idle;
     intptr_t mutex;
 } w_playback_status_t;
 
-static int CONFIG_REFRESH_INTERVAL = 100;
-static int CONFIG_NUM_LINES = 3;
-static const gchar *CONFIG_FORMAT[MAX_LINES];
+// Settings are saved with the gtkui layout, but gtkui only writes the layout
+// on its own edits. Settings changed in the dialog are therefore also stored
+// in the deadbeef config under the id of the instance, and take precedence
+// over the layout when it is loaded. The entry is removed as soon as the
+// layout holds the settings, it is only kept while they don't fit into it.
+static GSList *instances = NULL;
 
 static void
-save_config (void)
+config_free (playback_status_config_t *conf)
 {
-    deadbeef->conf_set_int (CONFSTR_VM_REFRESH_INTERVAL,            CONFIG_REFRESH_INTERVAL);
-    deadbeef->conf_set_int (CONFSTR_VM_NUM_LINES,            CONFIG_NUM_LINES);
-    char conf_format_str[100];
-    for (int i = 0; i < CONFIG_NUM_LINES; i++) {
-        snprintf (conf_format_str, sizeof (conf_format_str), "%s%02d", CONFSTR_VM_FORMAT, i);
-        deadbeef->conf_set_str (conf_format_str, CONFIG_FORMAT[i]);
+    for (int i = 0; i < MAX_LINES; i++) {
+        if (conf->format[i])
+            g_free (conf->format[i]);
+        conf->format[i] = NULL;
+    }
+    for (int i = 0; i < MAX_TOOLTIP_LINES; i++) {
+        if (conf->tooltip_format[i])
+            g_free (conf->tooltip_format[i]);
+        conf->tooltip_format[i] = NULL;
     }
-    return;
 }
 
+// loads the global settings, which are the defaults of new widget instances
 static void
 load_config (gpointer user_data)
 {
     w_playback_status_t *w = user_data;
+    playback_status_config_t *conf = &w->conf;
     deadbeef->mutex_lock (w->mutex);
-    for (int i = 0; i < MAX_LINES; i++) {
-        if (CONFIG_FORMAT[i])
-            g_free ((gchar *)CONFIG_FORMAT[i]);
-    }
+    config_free (conf);
     deadbeef->conf_lock ();
-    CONFIG_REFRESH_INTERVAL = deadbeef->conf_get_int (CONFSTR_VM_REFRESH_INTERVAL,          100);
-    CONFIG_NUM_LINES = deadbeef->conf_get_int (CONFSTR_VM_NUM_LINES,          3);
+    conf->refresh_interval = CLAMP (deadbeef->conf_get_int (CONFSTR_VM_REFRESH_INTERVAL,          100), MIN_REFRESH_INTERVAL, MAX_REFRESH_INTERVAL);
+    conf->num_lines = CLAMP (deadbeef->conf_get_int (CONFSTR_VM_NUM_LINES,          3), 1, MAX_LINES);
+    conf->fixed_layout = deadbeef->conf_get_int (CONFSTR_VM_FIXED_LAYOUT,          0);
+    conf->marquee = deadbeef->conf_get_int (CONFSTR_VM_MARQUEE,          0);
 
     char conf_format_str[1024];
-    for (int i = 0; i < CONFIG_NUM_LINES; i++) {
+    for (int i = 0; i < MAX_LINES; i++) {
         snprintf (conf_format_str, sizeof (conf_format_str), "%s%02d", CONFSTR_VM_FORMAT, i);
         if (i == 0) {
-            CONFIG_FORMAT[i] = strdup (deadbeef->conf_get_str_fast (conf_format_str, "<span foreground='grey' weight='bold' size='medium'>%playback_time% / %length%</span>"));
+            conf->format[i] = g_strdup (deadbeef->conf_get_str_fast (conf_format_str, "<span foreground='grey' weight='bold' size='medium'>%playback_time% / %length%</span>"));
         }
         else if (i == 1) {
-            CONFIG_FORMAT[i] = strdup (deadbeef->conf_get_str_fast (conf_format_str, "<span weight='bold' size='x-large'>%tracknumber%. %title%</span>"));
+            conf->format[i] = g_strdup (deadbeef->conf_get_str_fast (conf_format_str, "<span weight='bold' size='x-large'>%tracknumber%. %title%</span>"));
         }
         else if (i== 2) {
-            CONFIG_FORMAT[i] = strdup (deadbeef->conf_get_str_fast (conf_format_str, "%album% - <i>%album artist%</i>"));
+            conf->format[i] = g_strdup (deadbeef->conf_get_str_fast (conf_format_str, "%album% - <i>%album artist%</i>"));
+        }
+        else {
+            conf->format[i] = g_strdup (deadbeef->conf_get_str_fast (conf_format_str, ""));
+        }
+    }
+
+    conf->tooltip_num_lines = CLAMP (deadbeef->conf_get_int (CONFSTR_VM_TOOLTIP_NUM_LINES,          3), 0, MAX_TOOLTIP_LINES);
+    for (int i = 0; i < MAX_TOOLTIP_LINES; i++) {
+        snprintf (conf_format_str, sizeof (conf_format_str), "%s%02d", CONFSTR_VM_TOOLTIP_FORMAT, i);
+        if (i == 0) {
+            conf->tooltip_format[i] = g_strdup (deadbeef->conf_get_str_fast (conf_format_str, "<b>%codec%</b>$if(%bitrate%, %bitrate% kbps) %samplerate% Hz"));
+        }
+        else if (i == 1) {
+            conf->tooltip_format[i] = g_strdup (deadbeef->conf_get_str_fast (conf_format_str, "%path%"));
+        }
+        else if (i == 2) {
+            conf->tooltip_format[i] = g_strdup (deadbeef->conf_get_str_fast (conf_format_str, "<i>%comment%</i>"));
         }
         else {
-            CONFIG_FORMAT[i] = strdup (deadbeef->conf_get_str_fast (conf_format_str, ""));
+            conf->tooltip_format[i] = g_strdup (deadbeef->conf_get_str_fast (conf_format_str, ""));
         }
     }
 
@@ -106,25 +214,357 @@ load_config (gpointer user_data)
     deadbeef->mutex_unlock (w->mutex);
 }
 
-static int
-on_config_changed (gpointer user_data, uintptr_t ctx)
+// Compiled formats are shared by all widget instances: identical format
+// strings are compiled once and freed with their last user.
+// Only used from the main thread.
+typedef struct {
+    gchar *format;
+    char *bytecode;
+    int refcount;
+} tf_cache_entry_t;
+
+static GHashTable *tf_cache_formats = NULL;
+static GHashTable *tf_cache_bytecodes = NULL;
+
+static char *
+tf_cache_compile (const char *format)
 {
-    w_playback_status_t *w = user_data;
-    load_config (user_data);
+    if (!format) {
+        format = "";
+    }
+    if (!tf_cache_formats) {
+        tf_cache_formats = g_hash_table_new (g_str_hash, g_str_equal);
+        tf_cache_bytecodes = g_hash_table_new (g_direct_hash, g_direct_equal);
+    }
+    tf_cache_entry_t *entry = g_hash_table_lookup (tf_cache_formats, format);
+    if (!entry) {
+        char *bytecode = deadbeef->tf_compile (format);
+        if (!bytecode) {
+            return NULL;
+        }
+        entry = g_new0 (tf_cache_entry_t, 1);
+        entry->format = g_strdup (format);
+        entry->bytecode = bytecode;
+        g_hash_table_insert (tf_cache_formats, entry->format, entry);
+        g_hash_table_insert (tf_cache_bytecodes, entry->bytecode, entry);
+    }
+    entry->refcount++;
+    return entry->bytecode;
+}
+
+static void
+tf_cache_free (char *bytecode)
+{
+    tf_cache_entry_t *entry = tf_cache_bytecodes ? g_hash_table_lookup (tf_cache_bytecodes, bytecode) : NULL;
+    if (!entry || --entry->refcount > 0) {
+        return;
+    }
+    g_hash_table_remove (tf_cache_formats, entry->format);
+    g_hash_table_remove (tf_cache_bytecodes, entry->bytecode);
+    deadbeef->tf_free (entry->bytecode);
+    g_free (entry->format);
+    g_free (entry);
+}
+
+enum {
+    MEASURE_FIELD,
+    MEASURE_TRACK,
+    MEASURE_STREAM,
+};
+
+// time fields which change every tick, the field holding their widest value
+// and a placeholder for streams, whose length is empty
+static const char *measure_fields[][3] = {
+    { "%playback_time%",                   "%length%",         "00:00:00" },
+    { "%playback_time_remaining%",         "%length%",         "00:00:00" },
+    { "%playback_time_seconds%",           "%length_seconds%", "000000" },
+    { "%playback_time_remaining_seconds%", "%length_seconds%", "000000" },
+};
+
+// returns a copy of format with all time fields replaced by their maximum
+// (MEASURE_TRACK or MEASURE_STREAM), or NULL if format doesn't contain any
+// time fields
+static char *
+measure_format_new (const char *format, int measure_type)
+{
+    if (!format || !strstr (format, "%playback_time")) {
+        return NULL;
+    }
+    GString *measure = g_string_new (NULL);
+    const char *p = format;
+    while (*p) {
+        size_t i;
+        for (i = 0; i < G_N_ELEMENTS (measure_fields); i++) {
+            size_t len = strlen (measure_fields[i][MEASURE_FIELD]);
+            if (!strncmp (p, measure_fields[i][MEASURE_FIELD], len)) {
+                g_string_append (measure, measure_fields[i][measure_type]);
+                p += len;
+                break;
+            }
+        }
+        if (i == G_N_ELEMENTS (measure_fields)) {
+            g_string_append_c (measure, *p++);
+        }
+    }
+    return g_string_free (measure, FALSE);
+}
+
+static void
+playback_status_compile_line (w_playback_status_t *w, int i, const char *format)
+{
+    w->bytecode[i] = tf_cache_compile (format);
+    char *measure = measure_format_new (format, MEASURE_TRACK);
+    if (measure) {
+        w->measure_bytecode[i] = tf_cache_compile (measure);
+        g_free (measure);
+    }
+    measure = measure_format_new (format, MEASURE_STREAM);
+    if (measure) {
+        w->stream_measure_bytecode[i] = tf_cache_compile (measure);
+        g_free (measure);
+    }
+}
+
+static void
+playback_status_free_line (w_playback_status_t *w, int i)
+{
+    if (w->bytecode[i]) {
+        tf_cache_free (w->bytecode[i]);
+        w->bytecode[i] = NULL;
+    }
+    if (w->measure_bytecode[i]) {
+        tf_cache_free (w->measure_bytecode[i]);
+        w->measure_bytecode[i] = NULL;
+    }
+    if (w->stream_measure_bytecode[i]) {
+        tf_cache_free (w->stream_measure_bytecode[i]);
+        w->stream_measure_bytecode[i] = NULL;
+    }
+}
+
+// replace all digits outside of tags and entities with the given digit
+static void
+widen_digits (char *markup, char digit)
+{
+    int in_tag = 0;
+    int in_entity = 0;
+    for (char *p = markup; *p; p++) {
+        if (in_tag) {
+            in_tag = *p != '>';
+        }
+        else if (in_entity) {
+            in_entity = *p != ';';
+        }
+        else if (*p == '<') {
+            in_tag = 1;
+        }
+        else if (*p == '&') {
+            in_entity = 1;
+        }
+        else if (*p >= '0' && *p <= '9') {
+            *p = digit;
+        }
+    }
+}
+
+static char
+widest_digit (PangoLayout *layout)
+{
+    char digit = '0';
+    int max_width = 0;
+    for (char c = '0'; c <= '9'; c++) {
+        int width = 0;
+        pango_layout_set_text (layout, &c, 1);
+        pango_layout_get_pixel_size (layout, &width, NULL);
+        if (width > max_width) {
+            max_width = width;
+            digit = c;
+        }
+    }
+    return digit;
+}
+
+static void
+playback_status_line_set_drawn (playback_status_line_t *line, int drawn)
+{
+    if (line->drawn != drawn) {
+        line->drawn = drawn;
+        // the next update moves the text between label and widget
+        line->shown = 0;
+    }
+}
+
+// In fixed layout mode the height of every label is reserved once per track
+// and all lines are drawn by the widget within the allocation of their
+// label, so that updates of any field (time, VBR bitrate, ...) neither
+// change the size request of the widget nor queue a resize. The width of
+// the widest value of the time fields is only used to position the text,
+// a minimum width would keep long lines from being ellipsized.
+static void
+playback_status_reserve_geometry (w_playback_status_t *w)
+{
+    DB_playItem_t *playing = NULL;
+    if (w->conf.fixed_layout) {
+        playing = deadbeef->streamer_get_playing_track ();
+    }
+    deadbeef->mutex_lock (w->mutex);
+    for (int i = w->conf.num_lines; i < MAX_LINES; i++) {
+        playback_status_line_set_drawn (&w->line[i], 0);
+    }
+    if (!playing) {
+        for (int i = 0; i < MAX_LINES; i++) {
+            gtk_widget_set_size_request (w->label[i], -1, -1);
+            playback_status_line_set_drawn (&w->line[i], 0);
+        }
+        deadbeef->mutex_unlock (w->mutex);
+        return;
+    }
+    ddb_tf_context_t ctx = {
+        ._size = sizeof (ddb_tf_context_t),
+        .it = playing,
+        .plt = deadbeef->plt_get_curr (),
+    };
+    int stream = deadbeef->pl_get_item_duration (playing) <= 0;
+
+    char text[1024];
+    char markup[1100];
+    for (int i = 0; i < w->conf.num_lines; i++) {
+        PangoLayout *layout = gtk_widget_create_pango_layout (w->label[i], NULL);
+        char *measure_bytecode = stream ? w->stream_measure_bytecode[i] : w->measure_bytecode[i];
+        char *bytecode = measure_bytecode ? measure_bytecode : w->bytecode[i];
+        text[0] = 0;
+        if (bytecode) {
+            deadbeef->tf_eval (&ctx, bytecode, text, sizeof (text));
+        }
+        if (measure_bytecode) {
+            widen_digits (text, widest_digit (layout));
+        }
+        snprintf (markup, sizeof (markup), TABULAR_DIGITS_OPEN "%s" TABULAR_DIGITS_CLOSE, text);
+        pango_layout_set_markup (layout, markup, -1);
+
+        int width = 0;
+        int height = 0;
+        pango_layout_get_pixel_size (layout, &width, &height);
+        gtk_widget_set_size_request (w->label[i], -1, height);
+        w->line[i].reserved_width = measure_bytecode ? width : 0;
+        playback_status_line_set_drawn (&w->line[i], 1);
+        g_object_unref (layout);
+    }
+    if (ctx.plt) {
+        deadbeef->plt_unref (ctx.plt);
+        ctx.plt = NULL;
+    }
+    deadbeef->pl_item_unref (playing);
+    deadbeef->mutex_unlock (w->mutex);
+}
+
+static gboolean
+playback_status_reserve_geometry_cb (void *data) {
+    w_playback_status_t *w = data;
+    w->reserve_idle = 0;
+    playback_status_reserve_geometry (w);
+    return FALSE;
+}
+
+static void
+playback_status_queue_reserve_geometry (w_playback_status_t *w)
+{
+    if (!w->reserve_idle) {
+        w->reserve_idle = g_idle_add (playback_status_reserve_geometry_cb, w);
+    }
+}
+
+// forces a full markup parse on the next update of every line
+static void
+playback_status_invalidate_lines (w_playback_status_t *w)
+{
+    deadbeef->mutex_lock (w->mutex);
     for (int i = 0; i < MAX_LINES; i++) {
-        if (w->bytecode[i]) {
-            deadbeef->tf_free (w->bytecode[i]);
-            w->bytecode[i] = NULL;
+        w->line[i].shown = 0;
+        w->line[i].parsed = 0;
+    }
+    deadbeef->mutex_unlock (w->mutex);
+}
+
+static void
+playback_status_invalidate_tooltip (w_playback_status_t *w)
+{
+    deadbeef->mutex_lock (w->mutex);
+    if (w->tooltip) {
+        g_free (w->tooltip);
+        w->tooltip = NULL;
+    }
+    deadbeef->mutex_unlock (w->mutex);
+}
+
+static void
+playback_status_free_tooltip (w_playback_status_t *w)
+{
+    for (int i = 0; i < MAX_TOOLTIP_LINES; i++) {
+        if (w->tooltip_bytecode[i]) {
+            tf_cache_free (w->tooltip_bytecode[i]);
+            w->tooltip_bytecode[i] = NULL;
+        }
+    }
+    playback_status_invalidate_tooltip (w);
+}
+
+// tooltip formats are only compiled here, they are evaluated when a
+// tooltip is requested
+static void
+playback_status_compile_tooltip (w_playback_status_t *w)
+{
+    char *bytecode[MAX_TOOLTIP_LINES];
+    memcpy (bytecode, w->tooltip_bytecode, sizeof (bytecode));
+    memset (w->tooltip_bytecode, 0, sizeof (w->tooltip_bytecode));
+    for (int i = 0; i < w->conf.tooltip_num_lines; i++) {
+        w->tooltip_bytecode[i] = tf_cache_compile (w->conf.tooltip_format[i]);
+    }
+    for (int i = 0; i < MAX_TOOLTIP_LINES; i++) {
+        if (bytecode[i]) {
+            tf_cache_free (bytecode[i]);
         }
-        if (i < CONFIG_NUM_LINES) {
+    }
+    playback_status_invalidate_tooltip (w);
+    gtk_widget_set_has_tooltip (w->base.widget, w->conf.tooltip_num_lines > 0);
+}
+
+static gboolean
+playback_status_set_refresh_interval (gpointer user_data, int interval);
+
+static void
+playback_status_store_config (w_playback_status_t *w);
+
+// compiles the formats of w->conf and applies its settings to the widget
+static void
+playback_status_apply_config (w_playback_status_t *w)
+{
+    deadbeef->mutex_lock (w->mutex);
+    for (int i = 0; i < MAX_LINES; i++) {
+        // the old bytecode is released after compiling the new one, so
+        // unchanged formats are taken from the cache
+        char *bytecode[] = { w->bytecode[i], w->measure_bytecode[i], w->stream_measure_bytecode[i] };
+        w->bytecode[i] = NULL;
+        w->measure_bytecode[i] = NULL;
+        w->stream_measure_bytecode[i] = NULL;
+        if (i < w->conf.num_lines) {
             gtk_widget_show (w->label[i]);
-            w->bytecode[i] = deadbeef->tf_compile (CONFIG_FORMAT[i]);
+            playback_status_compile_line (w, i, w->conf.format[i]);
         }
         else {
             gtk_widget_hide (w->label[i]);
         }
+        for (size_t j = 0; j < G_N_ELEMENTS (bytecode); j++) {
+            if (bytecode[j]) {
+                tf_cache_free (bytecode[j]);
+            }
+        }
     }
-    return 0;
+    deadbeef->mutex_unlock (w->mutex);
+    playback_status_compile_tooltip (w);
+    playback_status_invalidate_lines (w);
+    playback_status_queue_reserve_geometry (w);
+    playback_status_set_refresh_interval (w, w->conf.refresh_interval);
 }
 
 static GtkWidget *format[MAX_LINES];
@@ -149,11 +589,22 @@ on_num_lines_changed (GtkSpinButton *spin, gpointer user_data)
 static void
 on_button_config (GtkMenuItem *menuitem, gpointer user_data)
 {
+    w_playback_status_t *w = user_data;
     GtkWidget *playback_status_properties;
     GtkWidget *config_dialog;
+    GtkWidget *vbox00;
+    GtkWidget *hbox00;
+    GtkWidget *refresh_interval_label;
+    GtkWidget *refresh_interval;
+    GtkWidget *fixed_layout;
+    GtkWidget *marquee;
     GtkWidget *hbox01;
     GtkWidget *vbox01;
     GtkWidget *num_lines;
+    GtkWidget *tooltip_frame;
+    GtkWidget *tooltip_scroll;
+    GtkWidget *tooltip_format;
+    GtkTextBuffer *tooltip_buffer;
     GtkWidget *dialog_action_area13;
     GtkWidget *applybutton1;
     GtkWidget *cancelbutton1;
@@ -168,6 +619,31 @@ on_button_config (GtkMenuItem *menuitem, gpointer user_data)
     config_dialog = gtk_dialog_get_content_area (GTK_DIALOG (playback_status_properties));
     gtk_widget_show (config_dialog);
 
+    vbox00 = gtk_vbox_new (FALSE, 8);
+    gtk_widget_show (vbox00);
+    gtk_box_pack_start (GTK_BOX (config_dialog), vbox00, FALSE, FALSE, 0);
+    gtk_container_set_border_width (GTK_CONTAINER (vbox00), 12);
+
+    hbox00 = gtk_hbox_new (FALSE, 8);
+    gtk_widget_show (hbox00);
+    gtk_box_pack_start (GTK_BOX (vbox00), hbox00, FALSE, FALSE, 0);
+
+    refresh_interval_label = gtk_label_new ("Refresh interval (ms):");
+    gtk_widget_show (refresh_interval_label);
+    gtk_box_pack_start (GTK_BOX (hbox00), refresh_interval_label, FALSE, FALSE, 0);
+
+    refresh_interval = gtk_spin_button_new_with_range (MIN_REFRESH_INTERVAL,MAX_REFRESH_INTERVAL,1);
+    gtk_widget_show (refresh_interval);
+    gtk_box_pack_start (GTK_BOX (hbox00), refresh_interval, FALSE, FALSE, 0);
+
+    fixed_layout = gtk_check_button_new_with_label ("Fixed layout (no window resize on status updates)");
+    gtk_widget_show (fixed_layout);
+    gtk_box_pack_start (GTK_BOX (vbox00), fixed_layout, FALSE, FALSE, 0);
+
+    marquee = gtk_check_button_new_with_label ("Scroll overlong lines (marquee)");
+    gtk_widget_show (marquee);
+    gtk_box_pack_start (GTK_BOX (vbox00), marquee, FALSE, FALSE, 0);
+
     hbox01 = gtk_hbox_new (FALSE, 8);
     gtk_widget_show (hbox01);
     gtk_box_pack_start (GTK_BOX (config_dialog), hbox01, FALSE, FALSE, 0);
@@ -177,82 +653,649 @@ on_button_config (GtkMenuItem *menuitem, gpointer user_data)
     gtk_box_pack_start (GTK_BOX (hbox01), vbox01, TRUE, TRUE, 0);
     gtk_widget_show (vbox01);
 
-    num_lines = gtk_spin_button_new_with_range (1,MAX_LINES,1);
-    gtk_widget_show (num_lines);
-    gtk_box_pack_start (GTK_BOX (vbox01), num_lines, FALSE, FALSE, 0);
-    g_signal_connect_after ((gpointer) num_lines, "value-changed", G_CALLBACK (on_num_lines_changed), user_data);
+    num_lines = gtk_spin_button_new_with_range (1,MAX_LINES,1);
+    gtk_widget_show (num_lines);
+    gtk_box_pack_start (GTK_BOX (vbox01), num_lines, FALSE, FALSE, 0);
+    g_signal_connect_after ((gpointer) num_lines, "value-changed", G_CALLBACK (on_num_lines_changed), user_data);
+
+    for (int i = 0; i < MAX_LINES; i++) {
+        format[i] = gtk_entry_new ();
+        gtk_widget_show (format[i]);
+        gtk_entry_set_invisible_char (GTK_ENTRY (format[i]), 8226);
+        gtk_entry_set_activates_default (GTK_ENTRY (format[i]), TRUE);
+        gtk_box_pack_start (GTK_BOX (vbox01), format[i], FALSE, FALSE, 0);
+        if (w->conf.format[i]) {
+            gtk_entry_set_text (GTK_ENTRY (format[i]), w->conf.format[i]);
+        }
+    }
+
+    tooltip_frame = gtk_frame_new ("Tooltip (one format per line)");
+    gtk_widget_show (tooltip_frame);
+    gtk_box_pack_start (GTK_BOX (config_dialog), tooltip_frame, TRUE, TRUE, 0);
+    gtk_container_set_border_width (GTK_CONTAINER (tooltip_frame), 12);
+
+    tooltip_scroll = gtk_scrolled_window_new (NULL, NULL);
+    gtk_widget_show (tooltip_scroll);
+    gtk_container_add (GTK_CONTAINER (tooltip_frame), tooltip_scroll);
+    gtk_container_set_border_width (GTK_CONTAINER (tooltip_scroll), 4);
+    gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (tooltip_scroll), GTK_POLICY_AUTOMATIC, GTK_POLICY_AUTOMATIC);
+    gtk_scrolled_window_set_shadow_type (GTK_SCROLLED_WINDOW (tooltip_scroll), GTK_SHADOW_IN);
+    gtk_widget_set_size_request (tooltip_scroll, -1, 100);
+
+    tooltip_format = gtk_text_view_new ();
+    gtk_widget_show (tooltip_format);
+    gtk_container_add (GTK_CONTAINER (tooltip_scroll), tooltip_format);
+    tooltip_buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (tooltip_format));
+    GString *tooltip_text = g_string_new (NULL);
+    for (int i = 0; i < w->conf.tooltip_num_lines; i++) {
+        g_string_append_printf (tooltip_text, "%s%s", i ? "\n" : "", w->conf.tooltip_format[i] ? w->conf.tooltip_format[i] : "");
+    }
+    gtk_text_buffer_set_text (tooltip_buffer, tooltip_text->str, -1);
+    g_string_free (tooltip_text, TRUE);
+
+    dialog_action_area13 = gtk_dialog_get_action_area (GTK_DIALOG (playback_status_properties));
+    gtk_widget_show (dialog_action_area13);
+    gtk_button_box_set_layout (GTK_BUTTON_BOX (dialog_action_area13), GTK_BUTTONBOX_END);
+
+    applybutton1 = gtk_button_new_from_stock ("gtk-apply");
+    gtk_widget_show (applybutton1);
+    gtk_dialog_add_action_widget (GTK_DIALOG (playback_status_properties), applybutton1, GTK_RESPONSE_APPLY);
+    gtk_widget_set_can_default (applybutton1, TRUE);
+
+    cancelbutton1 = gtk_button_new_from_stock ("gtk-cancel");
+    gtk_widget_show (cancelbutton1);
+    gtk_dialog_add_action_widget (GTK_DIALOG (playback_status_properties), cancelbutton1, GTK_RESPONSE_CANCEL);
+    gtk_widget_set_can_default (cancelbutton1, TRUE);
+
+    okbutton1 = gtk_button_new_from_stock ("gtk-ok");
+    gtk_widget_show (okbutton1);
+    gtk_dialog_add_action_widget (GTK_DIALOG (playback_status_properties), okbutton1, GTK_RESPONSE_OK);
+    gtk_widget_set_can_default (okbutton1, TRUE);
+
+    gtk_spin_button_set_value (GTK_SPIN_BUTTON (num_lines), w->conf.num_lines);
+    gtk_spin_button_set_value (GTK_SPIN_BUTTON (refresh_interval), w->conf.refresh_interval);
+    gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (fixed_layout), w->conf.fixed_layout);
+    gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (marquee), w->conf.marquee);
+    for (;;) {
+        int response = gtk_dialog_run (GTK_DIALOG (playback_status_properties));
+        if (response == GTK_RESPONSE_OK || response == GTK_RESPONSE_APPLY) {
+            // the settings only apply to this instance
+            deadbeef->mutex_lock (w->mutex);
+            playback_status_config_t *conf = &w->conf;
+            conf->refresh_interval = gtk_spin_button_get_value_as_int (GTK_SPIN_BUTTON (refresh_interval));
+            conf->fixed_layout = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (fixed_layout));
+            conf->marquee = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (marquee));
+            conf->num_lines = gtk_spin_button_get_value_as_int (GTK_SPIN_BUTTON (num_lines));
+            for (int i = 0; i < conf->num_lines; i++) {
+                g_free (conf->format[i]);
+                conf->format[i] = g_strdup (gtk_entry_get_text (GTK_ENTRY (format[i])));
+            }
+
+            GtkTextIter start, end;
+            gtk_text_buffer_get_bounds (tooltip_buffer, &start, &end);
+            gchar *text = gtk_text_buffer_get_text (tooltip_buffer, &start, &end, FALSE);
+            gchar **lines = g_strsplit (text, "\n", 0);
+            for (int i = 0; i < MAX_TOOLTIP_LINES; i++) {
+                g_free (conf->tooltip_format[i]);
+                conf->tooltip_format[i] = NULL;
+            }
+            conf->tooltip_num_lines = 0;
+            for (int i = 0; lines[i] && i < MAX_TOOLTIP_LINES; i++) {
+                conf->tooltip_format[i] = g_strdup (lines[i]);
+                if (*lines[i]) {
+                    // trailing empty lines are dropped
+                    conf->tooltip_num_lines = i + 1;
+                }
+            }
+            g_strfreev (lines);
+            g_free (text);
+            deadbeef->mutex_unlock (w->mutex);
+            playback_status_apply_config (w);
+            playback_status_store_config (w);
+        }
+        if (response == GTK_RESPONSE_APPLY) {
+            continue;
+        }
+        break;
+    }
+    gtk_widget_destroy (playback_status_properties);
+#pragma GCC diagnostic pop
+    return;
+}
+
+// returns the offset in the text of the given position in markup,
+// or -1 if the position is inside of a tag or an entity
+static int
+markup_text_offset (const char *markup, size_t pos)
+{
+    int offset = 0;
+    size_t i = 0;
+    while (i < pos) {
+        if (markup[i] == '<' || markup[i] == '&') {
+            const char *end = strchr (markup + i, markup[i] == '<' ? '>' : ';');
+            if (!end || (size_t)(end - markup) >= pos) {
+                return -1;
+            }
+            if (markup[i] == '&') {
+                if (markup[i+1] == '#') {
+                    gunichar c = markup[i+2] == 'x' ? strtoul (markup + i + 3, NULL, 16) : strtoul (markup + i + 2, NULL, 10);
+                    offset += g_unichar_to_utf8 (c, NULL);
+                }
+                else {
+                    // &amp; &lt; &gt; &quot; &apos;
+                    offset++;
+                }
+            }
+            i = end - markup + 1;
+        }
+        else {
+            offset++;
+            i++;
+        }
+    }
+    return offset;
+}
+
+#if !PANGO_VERSION_CHECK(1,44,0)
+typedef struct {
+    guint pos;
+    guint removed;
+    guint added;
+} attr_shift_t;
+
+static gboolean
+attr_shift_func (PangoAttribute *attr, gpointer user_data)
+{
+    attr_shift_t *shift = user_data;
+    guint end = shift->pos + shift->removed;
+    if (attr->start_index >= end) {
+        attr->start_index = attr->start_index - shift->removed + shift->added;
+    }
+    if (attr->end_index >= end && attr->end_index != G_MAXUINT) {
+        attr->end_index = attr->end_index - shift->removed + shift->added;
+    }
+    // keep all attributes
+    return FALSE;
+}
+#endif
+
+// replaces removed bytes at pos by added bytes in the ranges of attrs,
+// attributes covering the replaced text keep covering its replacement
+static void
+attr_list_replace (PangoAttrList *attrs, guint pos, guint removed, guint added)
+{
+#if PANGO_VERSION_CHECK(1,44,0)
+    // pango_attr_list_update moves attributes starting inside the removed
+    // range behind the added text, so the text is added behind the old one
+    // first and the old text removed afterwards
+    pango_attr_list_update (attrs, pos + removed, 0, added);
+    pango_attr_list_update (attrs, pos, removed, 0);
+#else
+    attr_shift_t shift = {
+        .pos = pos,
+        .removed = removed,
+        .added = added,
+    };
+    PangoAttrList *filtered = pango_attr_list_filter (attrs, attr_shift_func, &shift);
+    if (filtered) {
+        pango_attr_list_unref (filtered);
+    }
+#endif
+}
+
+// tries to apply the difference between the current markup and the new one
+// to text and attrs without parsing, which is possible if only text between
+// tags changed
+static int
+playback_status_line_update_text (playback_status_line_t *line, const char *markup)
+{
+    const char *old = line->markup->str;
+    size_t old_len = line->markup->len;
+    size_t new_len = strlen (markup);
+
+    size_t prefix = 0;
+    while (prefix < old_len && prefix < new_len && old[prefix] == markup[prefix]) {
+        prefix++;
+    }
+    while (prefix > 0 && ((unsigned char)markup[prefix] & 0xc0) == 0x80) {
+        prefix--;
+    }
+    size_t suffix = 0;
+    while (suffix < old_len - prefix && suffix < new_len - prefix
+           && old[old_len - 1 - suffix] == markup[new_len - 1 - suffix]) {
+        suffix++;
+    }
+    while (suffix > 0 && ((unsigned char)old[old_len - suffix] & 0xc0) == 0x80) {
+        suffix--;
+    }
+
+    size_t removed = old_len - prefix - suffix;
+    size_t added = new_len - prefix - suffix;
+    if (removed == 0) {
+        // a pure insertion next to a tag could belong to either side of it
+        return 0;
+    }
+    for (size_t i = 0; i < removed; i++) {
+        if (old[prefix + i] == '<' || old[prefix + i] == '&') {
+            return 0;
+        }
+    }
+    for (size_t i = 0; i < added; i++) {
+        if (markup[prefix + i] == '<' || markup[prefix + i] == '&') {
+            return 0;
+        }
+    }
+    int pos = markup_text_offset (old, prefix);
+    if (pos < 0) {
+        return 0;
+    }
+
+    g_string_erase (line->text, pos, removed);
+    g_string_insert_len (line->text, pos, markup + prefix, added);
+    attr_list_replace (line->attrs, pos, removed, added);
+    g_string_assign (line->markup, markup);
+    return 1;
+}
+
+static int
+playback_status_marquee_active (w_playback_status_t *w)
+{
+    for (int i = 0; i < MAX_LINES; i++) {
+        if (w->line[i].marquee) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// returns the scroll offset of line at the current marquee time
+static int
+playback_status_marquee_offset (w_playback_status_t *w, playback_status_line_t *line)
+{
+    int cycle = line->marquee_width + MARQUEE_GAP;
+    gint64 cycle_time = MARQUEE_PAUSE + (gint64)cycle * G_USEC_PER_SEC / MARQUEE_SPEED;
+    gint64 t = MAX (0, w->marquee_time - line->marquee_start) % cycle_time;
+    // whole pixel offsets keep the blit a plain copy
+    return t < MARQUEE_PAUSE ? 0 : (int)((t - MARQUEE_PAUSE) * MARQUEE_SPEED / G_USEC_PER_SEC);
+}
+
+// lines are only redrawn when their offset changed, not during the pause
+// or on frames between two pixel steps
+static void
+playback_status_marquee_step (w_playback_status_t *w, gint64 time)
+{
+    w->marquee_time = time;
+    for (int i = 0; i < MAX_LINES; i++) {
+        playback_status_line_t *line = &w->line[i];
+        if (line->marquee) {
+            int offset = playback_status_marquee_offset (w, line);
+            if (offset != line->marquee_offset) {
+                line->marquee_offset = offset;
+                gtk_widget_queue_draw (w->label[i]);
+            }
+        }
+    }
+}
+
+#if GTK_CHECK_VERSION(3,8,0)
+static gboolean
+playback_status_marquee_tick_cb (GtkWidget *widget, GdkFrameClock *frame_clock, gpointer user_data)
+{
+    playback_status_marquee_step (user_data, gdk_frame_clock_get_frame_time (frame_clock));
+    return G_SOURCE_CONTINUE;
+}
+#else
+static gboolean
+playback_status_marquee_timeout_cb (gpointer user_data)
+{
+    playback_status_marquee_step (user_data, g_get_monotonic_time ());
+    return TRUE;
+}
+#endif
+
+// the marquee only runs while there is something to scroll and the widget is visible
+static void
+playback_status_marquee_update_timer (w_playback_status_t *w)
+{
+    int run = playback_status_marquee_active (w) && gtk_widget_get_mapped (w->base.widget);
+    if (run && !w->marquee_timer) {
+        w->marquee_time = g_get_monotonic_time ();
+#if GTK_CHECK_VERSION(3,8,0)
+        w->marquee_timer = gtk_widget_add_tick_callback (w->vbox, playback_status_marquee_tick_cb, w, NULL);
+#else
+        w->marquee_timer = g_timeout_add (MARQUEE_INTERVAL, playback_status_marquee_timeout_cb, w);
+#endif
+    }
+    else if (!run && w->marquee_timer) {
+#if GTK_CHECK_VERSION(3,8,0)
+        gtk_widget_remove_tick_callback (w->vbox, w->marquee_timer);
+#else
+        g_source_remove (w->marquee_timer);
+#endif
+        w->marquee_timer = 0;
+    }
+}
+
+static void
+playback_status_marquee_free (playback_status_line_t *line)
+{
+    if (line->marquee) {
+        cairo_surface_destroy (line->marquee);
+        line->marquee = NULL;
+    }
+}
+
+// renders the line into an offscreen surface if it doesn't fit into its label,
+// scrolling then only blits that surface
+static void
+playback_status_marquee_render (w_playback_status_t *w, int i)
+{
+    playback_status_line_t *line = &w->line[i];
+    playback_status_marquee_free (line);
+    line->marquee_width = 0;
+    line->marquee_offset = -1;
+    if (!w->conf.marquee || !line->parsed) {
+        playback_status_marquee_update_timer (w);
+        return;
+    }
+
+    GtkWidget *label = w->label[i];
+    PangoLayout *layout = gtk_widget_create_pango_layout (label, line->text->str);
+    pango_layout_set_attributes (layout, line->attrs);
+    pango_layout_get_pixel_size (layout, &line->marquee_width, &line->marquee_height);
+
+    GtkAllocation a;
+    gtk_widget_get_allocation (label, &a);
+    if (a.width > 1 && line->marquee_width > a.width) {
+        int scale = 1;
+#if GTK_CHECK_VERSION(3,10,0) && CAIRO_VERSION >= CAIRO_VERSION_ENCODE(1,14,0)
+        scale = gtk_widget_get_scale_factor (label);
+#endif
+        line->marquee = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, line->marquee_width * scale, line->marquee_height * scale);
+#if GTK_CHECK_VERSION(3,10,0) && CAIRO_VERSION >= CAIRO_VERSION_ENCODE(1,14,0)
+        cairo_surface_set_device_scale (line->marquee, scale, scale);
+#endif
+        cairo_t *cr = cairo_create (line->marquee);
+#if GTK_CHECK_VERSION(3,0,0)
+        GdkRGBA color;
+        gtk_style_context_get_color (gtk_widget_get_style_context (label), gtk_widget_get_state_flags (label), &color);
+        gdk_cairo_set_source_rgba (cr, &color);
+#else
+        gdk_cairo_set_source_color (cr, &gtk_widget_get_style (label)->fg[gtk_widget_get_state (label)]);
+#endif
+        pango_cairo_show_layout (cr, layout);
+        cairo_destroy (cr);
+    }
+    g_object_unref (layout);
+    playback_status_marquee_update_timer (w);
+}
+
+static void
+playback_status_marquee_paint (w_playback_status_t *w, playback_status_line_t *line, cairo_t *cr, int width, int height)
+{
+    int cycle = line->marquee_width + MARQUEE_GAP;
+    int offset = playback_status_marquee_offset (w, line);
+    int y = (height - line->marquee_height) / 2;
+
+    cairo_rectangle (cr, 0, 0, width, height);
+    cairo_clip (cr);
+    cairo_set_source_surface (cr, line->marquee, -offset, y);
+    cairo_paint (cr);
+    if (cycle - offset < width) {
+        cairo_set_source_surface (cr, line->marquee, cycle - offset, y);
+        cairo_paint (cr);
+    }
+}
+
+// lays out a drawn line within the allocation of its label, ellipsized if
+// it doesn't fit, returns the position of the text
+static PangoLayout *
+playback_status_line_layout (GtkWidget *label, playback_status_line_t *line, int width, int height, int *x, int *y)
+{
+    PangoLayout *layout = gtk_widget_create_pango_layout (label, line->text->str);
+    pango_layout_set_attributes (layout, line->attrs);
+    pango_layout_set_ellipsize (layout, PANGO_ELLIPSIZE_END);
+    pango_layout_set_width (layout, width * PANGO_SCALE);
+    int text_width = 0;
+    int text_height = 0;
+    pango_layout_get_pixel_size (layout, &text_width, &text_height);
+    // centre the reserved width, the text starts at its left edge
+    int box_width = MIN (width, MAX (text_width, line->reserved_width));
+    *x = MAX (0, (width - box_width) / 2);
+    *y = (height - text_height) / 2;
+    return layout;
+}
+
+static playback_status_line_t *
+playback_status_line_for_label (w_playback_status_t *w, GtkWidget *label)
+{
+    for (int i = 0; i < MAX_LINES; i++) {
+        if (w->label[i] == label) {
+            return &w->line[i];
+        }
+    }
+    return NULL;
+}
+
+#if GTK_CHECK_VERSION(3,0,0)
+static gboolean
+playback_status_label_draw (GtkWidget *widget, cairo_t *cr, gpointer user_data)
+{
+    w_playback_status_t *w = user_data;
+    playback_status_line_t *line = playback_status_line_for_label (w, widget);
+    int width = gtk_widget_get_allocated_width (widget);
+    int height = gtk_widget_get_allocated_height (widget);
+    if (line && line->marquee) {
+        playback_status_marquee_paint (w, line, cr, width, height);
+        return TRUE;
+    }
+    if (line && line->drawn && line->parsed) {
+        int x, y;
+        PangoLayout *layout = playback_status_line_layout (widget, line, width, height, &x, &y);
+        gtk_render_layout (gtk_widget_get_style_context (widget), cr, x, y, layout);
+        g_object_unref (layout);
+        return TRUE;
+    }
+    return FALSE;
+}
+#else
+static gboolean
+playback_status_label_expose_event (GtkWidget *widget, GdkEventExpose *event, gpointer user_data)
+{
+    w_playback_status_t *w = user_data;
+    playback_status_line_t *line = playback_status_line_for_label (w, widget);
+    GtkAllocation a;
+    gtk_widget_get_allocation (widget, &a);
+    if (line && !line->marquee && line->drawn && line->parsed) {
+        int x, y;
+        PangoLayout *layout = playback_status_line_layout (widget, line, a.width, a.height, &x, &y);
+        gtk_paint_layout (gtk_widget_get_style (widget), event->window, gtk_widget_get_state (widget), FALSE,
+                          &event->area, widget, "label", a.x + x, a.y + y, layout);
+        g_object_unref (layout);
+        return TRUE;
+    }
+    if (!line || !line->marquee) {
+        return FALSE;
+    }
+    cairo_t *cr = gdk_cairo_create (event->window);
+    gdk_cairo_region (cr, event->region);
+    cairo_clip (cr);
+    cairo_translate (cr, a.x, a.y);
+    playback_status_marquee_paint (w, line, cr, a.width, a.height);
+    cairo_destroy (cr);
+    return TRUE;
+}
+#endif
+
+static void
+playback_status_label_size_allocate (GtkWidget *widget, GtkAllocation *allocation, gpointer user_data)
+{
+    w_playback_status_t *w = user_data;
+    deadbeef->mutex_lock (w->mutex);
+    for (int i = 0; i < MAX_LINES; i++) {
+        playback_status_line_t *line = &w->line[i];
+        if (w->label[i] == widget && w->conf.marquee && line->parsed
+            && (line->marquee_width > allocation->width) != (line->marquee != NULL)) {
+            playback_status_marquee_render (w, i);
+        }
+    }
+    deadbeef->mutex_unlock (w->mutex);
+}
+
+// the colour and scale of the text are baked into the marquee surface,
+// so it is rendered again when they change
+static void
+playback_status_label_restyle (GtkWidget *widget, gpointer user_data)
+{
+    w_playback_status_t *w = user_data;
+    deadbeef->mutex_lock (w->mutex);
+    for (int i = 0; i < MAX_LINES; i++) {
+        if (w->label[i] == widget && w->line[i].marquee) {
+            playback_status_marquee_render (w, i);
+            gtk_widget_queue_draw (widget);
+        }
+    }
+    deadbeef->mutex_unlock (w->mutex);
+}
+
+#if GTK_CHECK_VERSION(3,0,0)
+static void
+playback_status_label_state_flags_changed (GtkWidget *widget, GtkStateFlags previous, gpointer user_data)
+{
+    playback_status_label_restyle (widget, user_data);
+}
+#else
+static void
+playback_status_label_style_set (GtkWidget *widget, GtkStyle *previous, gpointer user_data)
+{
+    playback_status_label_restyle (widget, user_data);
+}
+
+static void
+playback_status_label_state_changed (GtkWidget *widget, GtkStateType previous, gpointer user_data)
+{
+    playback_status_label_restyle (widget, user_data);
+}
+#endif
+
+#if GTK_CHECK_VERSION(3,10,0)
+static void
+playback_status_label_scale_changed (GObject *object, GParamSpec *pspec, gpointer user_data)
+{
+    playback_status_label_restyle (GTK_WIDGET (object), user_data);
+}
+#endif
+
+static void
+playback_status_map (GtkWidget *widget, gpointer user_data)
+{
+    playback_status_marquee_update_timer (user_data);
+}
 
-    for (int i = 0; i < MAX_LINES; i++) {
-        format[i] = gtk_entry_new ();
-        gtk_widget_show (format[i]);
-        gtk_entry_set_invisible_char (GTK_ENTRY (format[i]), 8226);
-        gtk_entry_set_activates_default (GTK_ENTRY (format[i]), TRUE);
-        gtk_box_pack_start (GTK_BOX (vbox01), format[i], FALSE, FALSE, 0);
-        if (CONFIG_FORMAT [i]) {
-            gtk_entry_set_text (GTK_ENTRY (format[i]), CONFIG_FORMAT[i]);
+static void
+playback_status_line_set_markup (w_playback_status_t *w, int i, const char *markup)
+{
+    playback_status_line_t *line = &w->line[i];
+    GtkLabel *label = GTK_LABEL (w->label[i]);
+    if (!line->markup) {
+        line->markup = g_string_new (NULL);
+        line->text = g_string_new (NULL);
+    }
+    if (line->shown && !strcmp (line->markup->str, markup)) {
+        return;
+    }
+    if (line->shown && line->parsed && playback_status_line_update_text (line, markup)) {
+        if (line->drawn) {
+            // the reserved size stays, only the line is redrawn
+            gtk_widget_queue_draw (w->label[i]);
+        }
+        else {
+            // attrs were updated in place, hand them to the label again
+            gtk_label_set_attributes (label, line->attrs);
+            gtk_label_set_text (label, line->text->str);
         }
+        playback_status_marquee_render (w, i);
+        return;
     }
 
-    dialog_action_area13 = gtk_dialog_get_action_area (GTK_DIALOG (playback_status_properties));
-    gtk_widget_show (dialog_action_area13);
-    gtk_button_box_set_layout (GTK_BUTTON_BOX (dialog_action_area13), GTK_BUTTONBOX_END);
-
-    applybutton1 = gtk_button_new_from_stock ("gtk-apply");
-    gtk_widget_show (applybutton1);
-    gtk_dialog_add_action_widget (GTK_DIALOG (playback_status_properties), applybutton1, GTK_RESPONSE_APPLY);
-    gtk_widget_set_can_default (applybutton1, TRUE);
-
-    cancelbutton1 = gtk_button_new_from_stock ("gtk-cancel");
-    gtk_widget_show (cancelbutton1);
-    gtk_dialog_add_action_widget (GTK_DIALOG (playback_status_properties), cancelbutton1, GTK_RESPONSE_CANCEL);
-    gtk_widget_set_can_default (cancelbutton1, TRUE);
-
-    okbutton1 = gtk_button_new_from_stock ("gtk-ok");
-    gtk_widget_show (okbutton1);
-    gtk_dialog_add_action_widget (GTK_DIALOG (playback_status_properties), okbutton1, GTK_RESPONSE_OK);
-    gtk_widget_set_can_default (okbutton1, TRUE);
+    g_string_assign (line->markup, markup);
+    line->shown = 1;
 
-    gtk_spin_button_set_value (GTK_SPIN_BUTTON (num_lines), CONFIG_NUM_LINES);
-    for (;;) {
-        int response = gtk_dialog_run (GTK_DIALOG (playback_status_properties));
-        if (response == GTK_RESPONSE_OK || response == GTK_RESPONSE_APPLY) {
-            CONFIG_NUM_LINES = gtk_spin_button_get_value_as_int (GTK_SPIN_BUTTON (num_lines));
-            for (int i = 0; i < CONFIG_NUM_LINES; i++) {
-                if (CONFIG_FORMAT[i])
-                    g_free ((gchar *)CONFIG_FORMAT[i]);
-                CONFIG_FORMAT[i] = strdup (gtk_entry_get_text (GTK_ENTRY (format[i])));
-            }
-            save_config ();
-            deadbeef->sendmessage (DB_EV_CONFIGCHANGED, 0, 0, 0);
-        }
-        if (response == GTK_RESPONSE_APPLY) {
-            continue;
+    PangoAttrList *attrs = NULL;
+    char *text = NULL;
+    line->parsed = pango_parse_markup (markup, -1, 0, &attrs, &text, NULL, NULL);
+    if (!line->parsed) {
+        // let the label report the invalid markup
+        gtk_label_set_attributes (label, NULL);
+        gtk_label_set_markup (label, markup);
+        playback_status_marquee_render (w, i);
+        return;
+    }
+    if (line->attrs) {
+        pango_attr_list_unref (line->attrs);
+    }
+    line->attrs = attrs;
+    g_string_assign (line->text, text);
+    g_free (text);
+    if (line->drawn) {
+        if (*gtk_label_get_text (label)) {
+            gtk_label_set_attributes (label, NULL);
+            gtk_label_set_text (label, "");
         }
-        break;
+        gtk_widget_queue_draw (w->label[i]);
     }
-    gtk_widget_destroy (playback_status_properties);
-#pragma GCC diagnostic pop
-    return;
+    else {
+        gtk_label_set_attributes (label, line->attrs);
+        gtk_label_set_text (label, line->text->str);
+    }
+    line->marquee_start = g_get_monotonic_time ();
+    playback_status_marquee_render (w, i);
 }
 
 static void
 w_playback_status_destroy (ddb_gtkui_widget_t *w) {
     w_playback_status_t *s = (w_playback_status_t *)w;
+    // gtkui destroys the gtk widgets only after this, their signals must not
+    // reach the freed state and mutex anymore
+    for (int i = 0; i < MAX_LINES; ++i) {
+        g_signal_handlers_disconnect_by_data (s->label[i], s);
+    }
+    g_signal_handlers_disconnect_by_data (s->base.widget, s);
+    g_signal_handlers_disconnect_by_data (s->popup_item, s);
     deadbeef->vis_waveform_unlisten (w);
+    playback_status_free_tooltip (s);
     for (int i = 0; i < MAX_LINES; ++i) {
-        if (s->bytecode[i]) {
-            deadbeef->tf_free (s->bytecode[i]);
-            s->bytecode[i] = NULL;
+        playback_status_free_line (s, i);
+        playback_status_line_t *line = &s->line[i];
+        if (line->markup) {
+            g_string_free (line->markup, TRUE);
+            line->markup = NULL;
+        }
+        if (line->text) {
+            g_string_free (line->text, TRUE);
+            line->text = NULL;
+        }
+        if (line->attrs) {
+            pango_attr_list_unref (line->attrs);
+            line->attrs = NULL;
         }
+        playback_status_marquee_free (line);
     }
+    playback_status_marquee_update_timer (s);
     if (s->drawtimer) {
         g_source_remove (s->drawtimer);
         s->drawtimer = 0;
     }
+    if (s->reserve_idle) {
+        g_source_remove (s->reserve_idle);
+        s->reserve_idle = 0;
+    }
     if (s->surf) {
         cairo_surface_destroy (s->surf);
         s->surf = NULL;
     }
+    config_free (&s->conf);
+    instances = g_slist_remove (instances, s);
     if (s->mutex) {
         deadbeef->mutex_free (s->mutex);
         s->mutex = 0;
@@ -266,6 +1309,7 @@ playback_status_set_label_text (gpointer user_data)
     deadbeef->mutex_lock (w->mutex);
 
     char title[1024];
+    char markup[1100];
     DB_playItem_t *playing = deadbeef->streamer_get_playing_track ();
     if (playing) {
         ddb_tf_context_t ctx = {
@@ -274,9 +1318,15 @@ playback_status_set_label_text (gpointer user_data)
             .plt = deadbeef->plt_get_curr (),
         };
 
-        for (int i = 0; i < CONFIG_NUM_LINES; i++) {
+        for (int i = 0; i < w->conf.num_lines; i++) {
             deadbeef->tf_eval (&ctx, w->bytecode[i], title, sizeof (title));
-            gtk_label_set_markup (GTK_LABEL (w->label[i]), title);
+            if (w->conf.fixed_layout) {
+                snprintf (markup, sizeof (markup), TABULAR_DIGITS_OPEN "%s" TABULAR_DIGITS_CLOSE, title);
+                playback_status_line_set_markup (w, i, markup);
+            }
+            else {
+                playback_status_line_set_markup (w, i, title);
+            }
         }
         if (ctx.plt) {
             deadbeef->plt_unref (ctx.plt);
@@ -285,9 +1335,9 @@ playback_status_set_label_text (gpointer user_data)
         deadbeef->pl_item_unref (playing);
     }
     else {
-        gtk_label_set_markup (GTK_LABEL (w->label[0]), "<span weight='bold' size='x-large'>Stopped</span>");
-        for (int i = 1; i < CONFIG_NUM_LINES; i++) {
-            gtk_label_set_markup (GTK_LABEL (w->label[i]), "");
+        playback_status_line_set_markup (w, 0, "<span weight='bold' size='x-large'>Stopped</span>");
+        for (int i = 1; i < w->conf.num_lines; i++) {
+            playback_status_line_set_markup (w, i, "");
         }
     }
     deadbeef->mutex_unlock (w->mutex);
@@ -322,6 +1372,102 @@ playback_status_set_refresh_interval (gpointer user_data, int interval)
     return TRUE;
 }
 
+static int
+markup_valid (const char *markup)
+{
+    return pango_parse_markup (markup, -1, 0, NULL, NULL, NULL, NULL);
+}
+
+// returns markup with every '&' that doesn't start an entity escaped
+static char *
+markup_escape_ampersands (const char *markup)
+{
+    GString *escaped = g_string_new (NULL);
+    for (const char *p = markup; *p; p++) {
+        if (*p == '&') {
+            const char *end = p + 1;
+            while (g_ascii_isalnum (*end) || *end == '#') {
+                end++;
+            }
+            if (*end != ';' || end == p + 1) {
+                g_string_append (escaped, "&amp;");
+                continue;
+            }
+        }
+        g_string_append_c (escaped, *p);
+    }
+    return g_string_free (escaped, FALSE);
+}
+
+// field values like "Simon & Garfunkel" break the markup of their line,
+// stray ampersands are escaped and lines which are still invalid are shown
+// as plain text, so that one line can't break the whole tooltip
+static void
+tooltip_append_line (GString *tooltip, const char *line)
+{
+    if (tooltip->len) {
+        g_string_append_c (tooltip, '\n');
+    }
+    if (markup_valid (line)) {
+        g_string_append (tooltip, line);
+        return;
+    }
+    char *escaped = markup_escape_ampersands (line);
+    if (!markup_valid (escaped)) {
+        g_free (escaped);
+        escaped = g_markup_escape_text (line, -1);
+    }
+    g_string_append (tooltip, escaped);
+    g_free (escaped);
+}
+
+static char *
+playback_status_tooltip_eval (w_playback_status_t *w)
+{
+    DB_playItem_t *playing = deadbeef->streamer_get_playing_track ();
+    if (!playing) {
+        return NULL;
+    }
+    ddb_tf_context_t ctx = {
+        ._size = sizeof (ddb_tf_context_t),
+        .it = playing,
+        .plt = deadbeef->plt_get_curr (),
+    };
+    char text[1024];
+    GString *tooltip = g_string_new (NULL);
+    for (int i = 0; i < w->conf.tooltip_num_lines; i++) {
+        if (!w->tooltip_bytecode[i]) {
+            continue;
+        }
+        deadbeef->tf_eval (&ctx, w->tooltip_bytecode[i], text, sizeof (text));
+        if (*text) {
+            tooltip_append_line (tooltip, text);
+        }
+    }
+    if (ctx.plt) {
+        deadbeef->plt_unref (ctx.plt);
+        ctx.plt = NULL;
+    }
+    deadbeef->pl_item_unref (playing);
+    return g_string_free (tooltip, FALSE);
+}
+
+static gboolean
+playback_status_query_tooltip (GtkWidget *widget, gint x, gint y, gboolean keyboard_mode, GtkTooltip *tooltip, gpointer user_data)
+{
+    w_playback_status_t *w = user_data;
+    deadbeef->mutex_lock (w->mutex);
+    if (!w->tooltip) {
+        w->tooltip = playback_status_tooltip_eval (w);
+    }
+    gboolean show = w->tooltip && *w->tooltip;
+    if (show) {
+        gtk_tooltip_set_markup (tooltip, w->tooltip);
+    }
+    deadbeef->mutex_unlock (w->mutex);
+    return show;
+}
+
 static gboolean
 playback_status_button_press_event (GtkWidget *widget, GdkEventButton *event, gpointer user_data)
 {
@@ -343,6 +1489,172 @@ playback_status_button_release_event (GtkWidget *widget, GdkEventButton *event,
     return TRUE;
 }
 
+// The history is shared by all widget instances: the first one to see a track
+// start records the history lines, the record is written once the track ends.
+// The history lines have formats of their own, so that the records don't
+// depend on which instance saw the track first.
+static intptr_t history_mutex = 0;
+static int history_enabled = 0;
+static history_record_t history_pending;
+static DB_playItem_t *history_pending_track = NULL;
+static gchar *history_format[MAX_HISTORY_LINES];
+static char *history_bytecode[MAX_HISTORY_LINES];
+
+static void
+playback_status_history_finish_pending (float playtime)
+{
+    if (!history_pending_track) {
+        return;
+    }
+    history_pending.playtime = playtime;
+    history_append (&history_pending);
+    deadbeef->pl_item_unref (history_pending_track);
+    history_pending_track = NULL;
+}
+
+static void
+playback_status_history_free_formats (void)
+{
+    for (int i = 0; i < MAX_HISTORY_LINES; i++) {
+        if (history_bytecode[i]) {
+            deadbeef->tf_free (history_bytecode[i]);
+            history_bytecode[i] = NULL;
+        }
+        if (history_format[i]) {
+            g_free (history_format[i]);
+            history_format[i] = NULL;
+        }
+    }
+}
+
+// recompiles the history formats which changed, called with history_mutex held
+static void
+playback_status_history_load_formats (void)
+{
+    static const char *defaults[MAX_HISTORY_LINES] = {
+        HISTORY_FORMAT_00,
+        HISTORY_FORMAT_01,
+        HISTORY_FORMAT_02,
+    };
+    char conf_format_str[1024];
+    deadbeef->conf_lock ();
+    for (int i = 0; i < MAX_HISTORY_LINES; i++) {
+        snprintf (conf_format_str, sizeof (conf_format_str), "%s%02d", CONFSTR_VM_HISTORY_FORMAT, i);
+        const char *format = deadbeef->conf_get_str_fast (conf_format_str, defaults[i]);
+        if (history_format[i] && !strcmp (history_format[i], format)) {
+            continue;
+        }
+        g_free (history_format[i]);
+        history_format[i] = g_strdup (format);
+        if (history_bytecode[i]) {
+            deadbeef->tf_free (history_bytecode[i]);
+        }
+        history_bytecode[i] = *format ? deadbeef->tf_compile (format) : NULL;
+    }
+    deadbeef->conf_unlock ();
+}
+
+static void
+playback_status_history_configure (void)
+{
+    int enable = deadbeef->conf_get_int (CONFSTR_VM_HISTORY, 0);
+    deadbeef->mutex_lock (history_mutex);
+    if (enable && !history_enabled) {
+        char path[PATH_MAX];
+        snprintf (path, sizeof (path), "%s/playback_status_history.bin", deadbeef->get_system_dir (DDB_SYS_DIR_CONFIG));
+        history_start (path);
+    }
+    else if (!enable && history_enabled) {
+        playback_status_history_finish_pending (difftime (time (NULL), history_pending.started));
+        history_stop ();
+    }
+    history_enabled = enable;
+    if (history_enabled) {
+        playback_status_history_load_formats ();
+    }
+    deadbeef->mutex_unlock (history_mutex);
+}
+
+static void
+playback_status_history_track_started (ddb_event_track_t *ev)
+{
+    if (!history_enabled || !ev || !ev->track) {
+        return;
+    }
+    deadbeef->mutex_lock (history_mutex);
+    time_t started = ev->started_timestamp ? ev->started_timestamp : time (NULL);
+    if (history_pending_track == ev->track && history_pending.started == started) {
+        // already recorded by another instance
+        deadbeef->mutex_unlock (history_mutex);
+        return;
+    }
+    if (history_pending_track) {
+        playback_status_history_finish_pending (difftime (time (NULL), history_pending.started));
+    }
+    memset (&history_pending, 0, sizeof (history_pending));
+    history_pending.started = started;
+    history_pending_track = ev->track;
+    deadbeef->pl_item_ref (history_pending_track);
+
+    ddb_tf_context_t ctx = {
+        ._size = sizeof (ddb_tf_context_t),
+        .it = ev->track,
+        .plt = deadbeef->plt_get_curr (),
+    };
+    char title[1024];
+    size_t len = 0;
+    for (int i = 0; i < MAX_HISTORY_LINES; i++) {
+        if (!history_bytecode[i]) {
+            continue;
+        }
+        deadbeef->tf_eval (&ctx, history_bytecode[i], title, sizeof (title));
+        char *text = NULL;
+        const char *line = title;
+        if (pango_parse_markup (title, -1, 0, NULL, &text, NULL, NULL)) {
+            line = text;
+        }
+        int res = snprintf (history_pending.text + len, sizeof (history_pending.text) - len, "%s%s", history_pending.num_lines ? "\n" : "", line);
+        g_free (text);
+        history_pending.num_lines++;
+        if (res < 0 || len + res >= sizeof (history_pending.text)) {
+            break;
+        }
+        len += res;
+    }
+    if (ctx.plt) {
+        deadbeef->plt_unref (ctx.plt);
+        ctx.plt = NULL;
+    }
+    deadbeef->mutex_unlock (history_mutex);
+}
+
+static void
+playback_status_history_track_changed (ddb_event_trackchange_t *ev)
+{
+    if (!history_enabled || !ev) {
+        return;
+    }
+    deadbeef->mutex_lock (history_mutex);
+    if (history_pending_track && history_pending_track == ev->from) {
+        playback_status_history_finish_pending (ev->playtime);
+    }
+    deadbeef->mutex_unlock (history_mutex);
+}
+
+// only info changes of the playing track affect the tooltip
+static void
+playback_status_track_info_changed (w_playback_status_t *w, ddb_event_track_t *ev)
+{
+    DB_playItem_t *playing = deadbeef->streamer_get_playing_track ();
+    if (!playing) {
+        return;
+    }
+    if (!ev || !ev->track || ev->track == playing) {
+        playback_status_invalidate_tooltip (w);
+    }
+    deadbeef->pl_item_unref (playing);
+}
+
 static int
 playback_status_message (ddb_gtkui_widget_t *widget, uint32_t id, uintptr_t ctx, uint32_t p1, uint32_t p2)
 {
@@ -350,38 +1662,262 @@ playback_status_message (ddb_gtkui_widget_t *widget, uint32_t id, uintptr_t ctx,
 
     switch (id) {
         case DB_EV_SONGSTARTED:
-            playback_status_set_refresh_interval (w, CONFIG_REFRESH_INTERVAL);
+            playback_status_history_track_started ((ddb_event_track_t *)ctx);
+            playback_status_invalidate_lines (w);
+            playback_status_invalidate_tooltip (w);
+            playback_status_queue_reserve_geometry (w);
+            playback_status_set_refresh_interval (w, w->conf.refresh_interval);
+            break;
+        case DB_EV_SONGCHANGED:
+            playback_status_history_track_changed ((ddb_event_trackchange_t *)ctx);
+            playback_status_invalidate_tooltip (w);
+            break;
+        case DB_EV_TRACKINFOCHANGED:
+            playback_status_track_info_changed (w, (ddb_event_track_t *)ctx);
             break;
         case DB_EV_PAUSED:
             break;
         case DB_EV_STOP:
+            playback_status_queue_reserve_geometry (w);
             break;
         case DB_EV_CONFIGCHANGED:
-            on_config_changed (w, ctx);
-            playback_status_set_refresh_interval (w, CONFIG_REFRESH_INTERVAL);
+            playback_status_history_configure ();
             break;
     }
     return 0;
 }
 
+// appends a widget param to s, quotes and backslashes in value are escaped
 static void
-w_playback_status_init (ddb_gtkui_widget_t *w) {
-    w_playback_status_t *s = (w_playback_status_t *)w;
-    load_config (w);
-    for (int i = 0; i < MAX_LINES; i++) {
-        if (i < CONFIG_NUM_LINES) {
-            gtk_widget_show (s->label[i]);
-            s->bytecode[i] = deadbeef->tf_compile (CONFIG_FORMAT[i]);
+save_param (GString *s, const char *key, const char *value)
+{
+    g_string_append_printf (s, " %s=\"", key);
+    for (const char *p = value ? value : ""; *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            g_string_append_c (s, '\\');
         }
-        else {
-            gtk_widget_hide (s->label[i]);
-            s->bytecode[i] = NULL;
+        g_string_append_c (s, *p);
+    }
+    g_string_append_c (s, '"');
+}
+
+// returns the settings of conf as widget params
+static GString *
+config_params_new (playback_status_config_t *conf)
+{
+    GString *params = g_string_new (NULL);
+    char key[32];
+    g_string_append_printf (params, " interval=%d lines=%d fixed_layout=%d marquee=%d tooltip_lines=%d",
+            conf->refresh_interval, conf->num_lines, conf->fixed_layout, conf->marquee, conf->tooltip_num_lines);
+    for (int i = 0; i < conf->num_lines; i++) {
+        snprintf (key, sizeof (key), "format%d", i);
+        save_param (params, key, conf->format[i]);
+    }
+    for (int i = 0; i < conf->tooltip_num_lines; i++) {
+        snprintf (key, sizeof (key), "tooltip%d", i);
+        save_param (params, key, conf->tooltip_format[i]);
+    }
+    return params;
+}
+
+// parses one key=value widget param and returns a pointer behind it, key is
+// left empty for tokens which aren't key=value params
+static const char *
+load_param (const char *s, GString *key, GString *value)
+{
+    g_string_truncate (key, 0);
+    g_string_truncate (value, 0);
+    while (*s && *s != '=' && *s != '{' && !g_ascii_isspace (*s)) {
+        g_string_append_c (key, *s++);
+    }
+    if (*s != '=') {
+        g_string_truncate (key, 0);
+        return s;
+    }
+    s++;
+    if (*s == '"') {
+        for (s++; *s && *s != '"'; s++) {
+            if (s[0] == '\\' && (s[1] == '"' || s[1] == '\\')) {
+                s++;
+            }
+            g_string_append_c (value, *s);
+        }
+        // an unterminated value ends with the string
+        if (*s) {
+            s++;
+        }
+    }
+    else {
+        while (*s && *s != '{' && !g_ascii_isspace (*s)) {
+            g_string_append_c (value, *s++);
+        }
+    }
+    return s;
+}
+
+static void
+load_config_value (w_playback_status_t *w, const char *key, const char *value)
+{
+    playback_status_config_t *conf = &w->conf;
+    int i;
+    if (!strcmp (key, "id")) {
+        w->id = strtoul (value, NULL, 16);
+    }
+    else if (!strcmp (key, "interval")) {
+        conf->refresh_interval = CLAMP (atoi (value), MIN_REFRESH_INTERVAL, MAX_REFRESH_INTERVAL);
+    }
+    else if (!strcmp (key, "lines")) {
+        conf->num_lines = CLAMP (atoi (value), 1, MAX_LINES);
+    }
+    else if (!strcmp (key, "fixed_layout")) {
+        conf->fixed_layout = atoi (value);
+    }
+    else if (!strcmp (key, "marquee")) {
+        conf->marquee = atoi (value);
+    }
+    else if (!strcmp (key, "tooltip_lines")) {
+        conf->tooltip_num_lines = CLAMP (atoi (value), 0, MAX_TOOLTIP_LINES);
+    }
+    else if (sscanf (key, "format%d", &i) == 1 && i >= 0 && i < MAX_LINES) {
+        g_free (conf->format[i]);
+        conf->format[i] = g_strdup (value);
+    }
+    else if (sscanf (key, "tooltip%d", &i) == 1 && i >= 0 && i < MAX_TOOLTIP_LINES) {
+        g_free (conf->tooltip_format[i]);
+        conf->tooltip_format[i] = g_strdup (value);
+    }
+}
+
+// reads widget params up to the end of s or the '{' of the children,
+// unknown and malformed params are skipped
+static const char *
+load_params (w_playback_status_t *w, const char *s)
+{
+    GString *key = g_string_new (NULL);
+    GString *value = g_string_new (NULL);
+    deadbeef->mutex_lock (w->mutex);
+    for (;;) {
+        while (g_ascii_isspace (*s)) {
+            s++;
+        }
+        if (!*s || *s == '{') {
+            break;
+        }
+        s = load_param (s, key, value);
+        if (key->len) {
+            load_config_value (w, key->str, value->str);
+        }
+    }
+    deadbeef->mutex_unlock (w->mutex);
+    g_string_free (key, TRUE);
+    g_string_free (value, TRUE);
+    return s;
+}
+
+static void
+playback_status_instance_key (w_playback_status_t *w, char *key, size_t size)
+{
+    snprintf (key, size, "%s%08x", CONFSTR_VM_INSTANCE, w->id);
+}
+
+static void
+playback_status_store_config (w_playback_status_t *w)
+{
+    char key[64];
+    playback_status_instance_key (w, key, sizeof (key));
+    deadbeef->mutex_lock (w->mutex);
+    GString *params = config_params_new (&w->conf);
+    deadbeef->mutex_unlock (w->mutex);
+    deadbeef->conf_set_str (key, params->str);
+    g_string_free (params, TRUE);
+    deadbeef->conf_save ();
+}
+
+// returns whether another instance than w uses id
+static int
+playback_status_id_in_use (w_playback_status_t *w, guint32 id)
+{
+    for (GSList *l = instances; l; l = l->next) {
+        if (l->data != w && ((w_playback_status_t *)l->data)->id == id) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// new instances and copies of existing ones get an id of their own, all
+// others take the settings stored under their id
+static void
+playback_status_load_instance (w_playback_status_t *w)
+{
+    if (!w->id || playback_status_id_in_use (w, w->id)) {
+        do {
+            w->id = g_random_int ();
+        } while (!w->id || playback_status_id_in_use (w, w->id));
+    }
+    else {
+        char key[64];
+        playback_status_instance_key (w, key, sizeof (key));
+        deadbeef->conf_lock ();
+        gchar *params = g_strdup (deadbeef->conf_get_str_fast (key, NULL));
+        deadbeef->conf_unlock ();
+        if (params) {
+            load_params (w, params);
+            g_free (params);
         }
     }
-    deadbeef->mutex_lock (s->mutex);
+    if (!g_slist_find (instances, w)) {
+        instances = g_slist_prepend (instances, w);
+    }
+}
+
+static void
+w_playback_status_init (ddb_gtkui_widget_t *w) {
+    w_playback_status_t *s = (w_playback_status_t *)w;
+    playback_status_load_instance (s);
+    playback_status_apply_config (s);
+}
+
+// params which don't fit into s are left out, the settings are then kept in
+// the deadbeef config only, otherwise their config entry is removed
+static void
+w_playback_status_save (ddb_gtkui_widget_t *widget, char *s, int sz)
+{
+    w_playback_status_t *w = (w_playback_status_t *)widget;
+    size_t len = strlen (s);
+    char id[32];
+    snprintf (id, sizeof (id), " id=%08x", w->id);
+    if (len + strlen (id) >= (size_t)sz) {
+        return;
+    }
+    g_strlcat (s, id, sz);
+    len += strlen (id);
 
-    playback_status_set_refresh_interval (w, CONFIG_REFRESH_INTERVAL);
-    deadbeef->mutex_unlock (s->mutex);
+    deadbeef->mutex_lock (w->mutex);
+    GString *params = config_params_new (&w->conf);
+    deadbeef->mutex_unlock (w->mutex);
+    if (len + params->len < (size_t)sz) {
+        // the layout holds the settings now, the config entry is obsolete
+        char key[64];
+        playback_status_instance_key (w, key, sizeof (key));
+        g_strlcat (s, params->str, sz);
+        deadbeef->conf_remove_items (key);
+    }
+    else {
+        playback_status_store_config (w);
+    }
+    g_string_free (params, TRUE);
+}
+
+// reads the params written by w_playback_status_save, settings missing
+// from them keep the global defaults
+static const char *
+w_playback_status_load (ddb_gtkui_widget_t *widget, const char *type, const char *s)
+{
+    if (strcmp (type, "playback_status")) {
+        return NULL;
+    }
+    return load_params ((w_playback_status_t *)widget, s);
 }
 
 ddb_gtkui_widget_t *
@@ -393,17 +1929,33 @@ w_playback_status_create (void) {
     w->base.init = w_playback_status_init;
     w->base.destroy  = w_playback_status_destroy;
     w->base.message = playback_status_message;
-    GtkWidget *vbox = gtk_vbox_new (FALSE, 4);
+    w->base.load = w_playback_status_load;
+    w->base.save = w_playback_status_save;
+    GtkWidget *vbox = w->vbox = gtk_vbox_new (FALSE, 4);
     gtk_container_set_border_width (GTK_CONTAINER (vbox), 4);
     for (int i = 0; i < MAX_LINES; ++i) {
         w->label[i] = gtk_label_new (NULL);
         gtk_label_set_ellipsize (GTK_LABEL (w->label[i]), PANGO_ELLIPSIZE_END);
         gtk_box_pack_start (GTK_BOX (vbox), w->label[i], FALSE, FALSE, 0);
         gtk_widget_show (w->label[i]);
+#if GTK_CHECK_VERSION(3,0,0)
+        g_signal_connect ((gpointer) w->label[i], "draw", G_CALLBACK (playback_status_label_draw), w);
+        g_signal_connect_after ((gpointer) w->label[i], "style-updated", G_CALLBACK (playback_status_label_restyle), w);
+        g_signal_connect_after ((gpointer) w->label[i], "state-flags-changed", G_CALLBACK (playback_status_label_state_flags_changed), w);
+#else
+        g_signal_connect ((gpointer) w->label[i], "expose_event", G_CALLBACK (playback_status_label_expose_event), w);
+        g_signal_connect_after ((gpointer) w->label[i], "style-set", G_CALLBACK (playback_status_label_style_set), w);
+        g_signal_connect_after ((gpointer) w->label[i], "state-changed", G_CALLBACK (playback_status_label_state_changed), w);
+#endif
+#if GTK_CHECK_VERSION(3,10,0)
+        g_signal_connect ((gpointer) w->label[i], "notify::scale-factor", G_CALLBACK (playback_status_label_scale_changed), w);
+#endif
+        g_signal_connect_after ((gpointer) w->label[i], "size_allocate", G_CALLBACK (playback_status_label_size_allocate), w);
     }
     w->popup = gtk_menu_new ();
     w->popup_item = gtk_menu_item_new_with_mnemonic ("Configure");
     w->mutex = deadbeef->mutex_create ();
+    load_config (w);
 
     gtk_container_add (GTK_CONTAINER (w->base.widget), vbox);
     gtk_container_add (GTK_CONTAINER (w->popup), w->popup_item);
@@ -415,6 +1967,9 @@ w_playback_status_create (void) {
     g_signal_connect_after ((gpointer) w->base.widget, "button_press_event", G_CALLBACK (playback_status_button_press_event), w);
     g_signal_connect_after ((gpointer) w->base.widget, "button_release_event", G_CALLBACK (playback_status_button_release_event), w);
     g_signal_connect_after ((gpointer) w->popup_item, "activate", G_CALLBACK (on_button_config), w);
+    g_signal_connect ((gpointer) w->base.widget, "query-tooltip", G_CALLBACK (playback_status_query_tooltip), w);
+    g_signal_connect_after ((gpointer) w->base.widget, "map", G_CALLBACK (playback_status_map), w);
+    g_signal_connect_after ((gpointer) w->base.widget, "unmap", G_CALLBACK (playback_status_map), w);
     gtkui_plugin->w_override_signals (w->base.widget, w);
     gtk_widget_set_events (w->base.widget, GDK_EXPOSURE_MASK
                                          | GDK_LEAVE_NOTIFY_MASK
@@ -443,12 +1998,26 @@ playback_status_connect (void)
 int
 playback_status_start (void)
 {
+    history_mutex = deadbeef->mutex_create ();
+    playback_status_history_configure ();
     return 0;
 }
 
 int
 playback_status_stop (void)
 {
+    if (history_mutex) {
+        deadbeef->mutex_lock (history_mutex);
+        if (history_enabled) {
+            playback_status_history_finish_pending (difftime (time (NULL), history_pending.started));
+            history_stop ();
+            history_enabled = 0;
+        }
+        playback_status_history_free_formats ();
+        deadbeef->mutex_unlock (history_mutex);
+        deadbeef->mutex_free (history_mutex);
+        history_mutex = 0;
+    }
     return 0;
 }
 
@@ -471,7 +2040,10 @@ playback_status_disconnect (void)
 }
 
 static const char settings_dlg[] =
-    "property \"Refresh interval (ms): \"           spinbtn[10,1000,1] "      CONFSTR_VM_REFRESH_INTERVAL         " 25 ;\n"
+    "property \"Keep playback history\" checkbox " CONFSTR_VM_HISTORY " 0 ;\n"
+    "property \"History line 1\" entry " CONFSTR_VM_HISTORY_FORMAT "00 \"" HISTORY_FORMAT_00 "\" ;\n"
+    "property \"History line 2\" entry " CONFSTR_VM_HISTORY_FORMAT "01 \"" HISTORY_FORMAT_01 "\" ;\n"
+    "property \"History line 3\" entry " CONFSTR_VM_HISTORY_FORMAT "02 \"" HISTORY_FORMAT_02 "\" ;\n"
 ;
 
 static DB_misc_t plugin = {
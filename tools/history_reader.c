@@ -0,0 +1,165 @@
+/*
+    Playback history reader for the Playback Status Widget plugin
+
+    Copyright (C) 2015 Christian Boxdörfer <christian.boxdoerfer@posteo.de>
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../history.h"
+
+static void
+usage (const char *name)
+{
+    fprintf (stderr, "Usage: %s [-l] FILE\n"
+                     "Prints the number of plays per hour of the day (local time).\n"
+                     "  -l  list all records instead\n", name);
+}
+
+// prints text up to its first zero byte, with line breaks and backslashes
+// escaped so that every record stays on a single line
+static void
+print_escaped (const char *text, size_t size)
+{
+    for (size_t i = 0; i < size && text[i]; i++) {
+        if (text[i] == '\n') {
+            fputs ("\\n", stdout);
+        }
+        else if (text[i] == '\\') {
+            fputs ("\\\\", stdout);
+        }
+        else {
+            putchar (text[i]);
+        }
+    }
+}
+
+static void
+list_records (const history_record_t *records, size_t num_records)
+{
+    for (size_t i = 0; i < num_records; i++) {
+        time_t started = records[i].started;
+        struct tm tm;
+        char date[32];
+        localtime_r (&started, &tm);
+        strftime (date, sizeof (date), "%Y-%m-%d %H:%M:%S", &tm);
+        printf ("%s  %7.1fs  ", date, records[i].playtime);
+        print_escaped (records[i].text, sizeof (records[i].text));
+        putchar ('\n');
+    }
+}
+
+static void
+plays_per_hour (const history_record_t *records, size_t num_records)
+{
+    size_t plays[24] = {0};
+    double playtime[24] = {0};
+
+    // records are appended in order, so consecutive ones mostly share the
+    // same hour and localtime is only needed when leaving it
+    time_t hour_start = 0;
+    time_t hour_end = 0;
+    int hour = 0;
+    for (size_t i = 0; i < num_records; i++) {
+        time_t started = records[i].started;
+        if (started < hour_start || started >= hour_end) {
+            struct tm tm;
+            localtime_r (&started, &tm);
+            hour = tm.tm_hour;
+            hour_start = started - tm.tm_min * 60 - tm.tm_sec;
+            hour_end = hour_start + 3600;
+        }
+        plays[hour]++;
+        playtime[hour] += records[i].playtime;
+    }
+
+    printf ("hour      plays   played (h)\n");
+    for (int i = 0; i < 24; i++) {
+        printf ("%02d:00  %9zu  %11.1f\n", i, plays[i], playtime[i] / 3600);
+    }
+    printf ("total  %9zu\n", num_records);
+}
+
+int
+main (int argc, char *argv[])
+{
+    int list = 0;
+    const char *path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp (argv[i], "-l")) {
+            list = 1;
+        }
+        else if (!path && argv[i][0] != '-') {
+            path = argv[i];
+        }
+        else {
+            usage (argv[0]);
+            return 1;
+        }
+    }
+    if (!path) {
+        usage (argv[0]);
+        return 1;
+    }
+
+    int fd = open (path, O_RDONLY);
+    if (fd < 0) {
+        fprintf (stderr, "%s: %s\n", path, strerror (errno));
+        return 1;
+    }
+    struct stat st;
+    if (fstat (fd, &st) < 0 || st.st_size < (off_t)sizeof (history_header_t)) {
+        fprintf (stderr, "%s: not a playback history\n", path);
+        close (fd);
+        return 1;
+    }
+    const char *data = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close (fd);
+    if (data == MAP_FAILED) {
+        fprintf (stderr, "%s: %s\n", path, strerror (errno));
+        return 1;
+    }
+    madvise ((void *)data, st.st_size, MADV_SEQUENTIAL);
+
+    const history_header_t *header = (const history_header_t *)data;
+    if (memcmp (header->magic, HISTORY_MAGIC, sizeof (header->magic))
+        || header->version != HISTORY_VERSION
+        || header->record_size != sizeof (history_record_t)) {
+        fprintf (stderr, "%s: not a playback history or unsupported version\n", path);
+        munmap ((void *)data, st.st_size);
+        return 1;
+    }
+    const history_record_t *records = (const history_record_t *)(data + sizeof (history_header_t));
+    size_t num_records = (st.st_size - sizeof (history_header_t)) / sizeof (history_record_t);
+
+    if (list) {
+        list_records (records, num_records);
+    }
+    else {
+        plays_per_hour (records, num_records);
+    }
+    munmap ((void *)data, st.st_size);
+    return 0;
+}